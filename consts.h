@@ -111,6 +111,33 @@ enum
 
 // octaedit
 
+enum
+{
+    EditCodec_Zlib = 0, // legacy format, serialized cubes compressed with zlib
+    EditCodec_Block,    // run length & texture dictionary coded cubes, LZ compressed
+    EditCodec_NumCodecs
+};
+
+enum
+{
+    EditLog_Face = 0,  // push or pull a face of the selection
+    EditLog_Tex,       // retexture the selection
+    EditLog_Mat,       // set the material of the selection
+    EditLog_Flip,      // mirror the selection
+    EditLog_Rotate,    // rotate the selection
+    EditLog_Replace,   // replace a texture in the selection or world
+    EditLog_Paste,     // paste a copied block into the selection
+    EditLog_Delete,    // delete the contents of the selection
+    EditLog_VSlot,     // edit the vslot properties of the selection's textures
+    EditLog_Undo,      // paste the packed undo block carried by the op (as made by packundo())
+    EditLog_Redo,      // paste the packed redo block carried by the op (as made by packundo())
+    EditLog_Remip,     // remip the world
+    EditLog_CalcLight, // recalculate lighting for the world
+    EditLog_Entity,    // add, move, modify or delete a map entity
+    EditLog_Var,       // set a map variable
+    EditLog_NumOps
+};
+
 enum
 {
     EditMatFlag_Empty    = 0x10000,
@@ -119,6 +146,15 @@ enum
     EditMatFlag_NotSolid = 0x40000
 };
 
+// heightmap
+
+enum
+{
+    HeightmapBrush_Push = 0, // raise or lower by the brush weights
+    HeightmapBrush_Smooth,   // average with neighboring columns
+    HeightmapBrush_Flatten   // move toward the height at the brush center
+};
+
 //particles
 enum
 {
@@ -172,6 +208,18 @@ enum
     Model_ForceTransparent = 1<<11
 };
 
+//renderwindow
+enum
+{
+    FramePhase_Physics = 0,
+    FramePhase_Particles,
+    FramePhase_OctaRender,
+    FramePhase_UI,
+    FramePhase_Script,
+    FramePhase_Sound,
+    FramePhase_NumPhases
+};
+
 //sound
 enum
 {
@@ -81,7 +81,8 @@ namespace gle
      * @brief Calls glVertexAttrib of the appropriate dimension.
      *
      * If the alpha value (w) is 0, glVertexAttrib3f is called, else glVertexAttrib4f.
-     * Sets the color of the attribute currently active.
+     * Sets the color of the attribute currently active. Inside a beginbatch()
+     * scope, the pending batch is drawn first if the color changes.
      *
      * @param x the red channel (0..1)
      * @param y the green channel (0..1)
@@ -93,6 +94,9 @@ namespace gle
     /**
      * @brief Calls glVertexAttrib4Nub to set the color of an attribute.
      *
+     * Inside a beginbatch() scope, the pending batch is drawn first if the
+     * color changes.
+     *
      * @param x the red channel (0..255)
      * @param y the green channel (0..255)
      * @param z the blue channel (0..255)
@@ -104,11 +108,67 @@ namespace gle
      * @brief Sets texcoord0 with the given dimensionality and type.
      *
      * @param size the number of dimensions to use
-     * @param the GL format of the dimensions
+     * @param format the GL format of the dimensions
      */
     extern void deftexcoord0(int size = 2, int format = GL_FLOAT);
+
+    /**
+     * @brief Sets the vertex position attribute with the given dimensionality and type.
+     *
+     * @param size the number of dimensions to use
+     * @param format the GL format of the dimensions
+     */
     extern void defvertex(int size = 3, int format = GL_FLOAT);
+
+    /**
+     * @brief Finishes the primitive started by begin().
+     *
+     * Outside of a beginbatch()/endbatch() scope, the primitive is drawn
+     * immediately. Inside such a scope, list primitives (GL_POINTS, GL_LINES,
+     * GL_TRIANGLES) using the same primitive type and vertex format as the
+     * previous block are appended to the pending batch in the ring buffer instead
+     * of being drawn; otherwise, the pending batch is drawn first. Strip, loop
+     * and fan primitives (e.g. GL_LINE_LOOP, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN)
+     * cannot be concatenated, so they always flush the pending batch and are
+     * drawn immediately.
+     *
+     * @return the number of vertices in the primitive
+     */
     extern int end();
+
+    /**
+     * @brief Starts a scope in which consecutive primitives may be merged.
+     *
+     * gle only tracks the primitive type and vertex format of each block, so
+     * the caller must not change any other GL state (shaders, textures,
+     * blending, uniforms) inside the scope without first calling flush().
+     * The constant color set by colorf()/colorub() applies to a whole draw, so
+     * those functions flush the pending batch themselves when they change the
+     * color.
+     */
+    extern void beginbatch();
+
+    /**
+     * @brief Ends the scope started by beginbatch(), drawing any pending batch.
+     */
+    extern void endbatch();
+
+    /**
+     * @brief Draws any batched primitives which have not yet been drawn.
+     *
+     * Only has an effect inside a beginbatch()/endbatch() scope. Must be called
+     * before changing GL state which gle does not track, so that batched
+     * primitives render with the state they were submitted with.
+     */
+    extern void flush();
+
+    /**
+     * @brief Returns the primitive batching counters for the last frame.
+     *
+     * @param submitted assigned the number of begin()/end() blocks submitted
+     * @param issued assigned the number of draw calls actually issued to GL
+     */
+    extern void getbatchstats(int &submitted, int &issued);
 }
 /*==============================================================================*\
  * Interface Functions & Values                                                 *
@@ -120,6 +180,7 @@ namespace gle
  * control.cpp                                                                  *
  * cubestd.cpp                                                                  *
  * input.cpp                                                                    *
+ * jobs.cpp                                                                     *
  * menus.cpp                                                                    *
  * textedit.cpp                                                                 *
  * ui.cpp                                                                       *
@@ -195,6 +256,8 @@ extern int initing;
  * @brief Clears the console KeyM history hashtable.
  *
  * Empties the KeyM hashtable keyms, typicall used when shutting down the program.
+ * Also empties the console line buffer, which holds up to `maxcon` lines in a
+ * fixed size ring and discards the oldest line once full.
  */
 extern void clear_console();
 
@@ -273,13 +336,30 @@ FILE *getlogfile();
  * @brief Prints a line to the log file.
  *
  * This function behaves the same way as printf(), except it prints to the
- * output specified in `getlogfile()`.
+ * output specified in `getlogfile()`. The line is queued to the log writer
+ * thread, so this function does not wait on the file to be written.
  *
  * @param fmt The string to print
  * @param ... the names of variables to substitute into the string, in order
  */
 void logoutf(const char *fmt, ...);
 
+/**
+ * @brief Writes all queued log lines to the log file.
+ *
+ * Blocks until the log writer thread has written every line queued by logoutf()
+ * and flushed the log file. Should be called before the program exits
+ * normally.
+ *
+ * This function is not used on fatal errors or crashes, since the writer
+ * thread may itself have crashed, another thread may hold the queue, and it is
+ * not safe to call from a signal handler. Instead, `fatal()` and the engine's
+ * crash handler write the lines still in the queue from the calling thread
+ * with plain writes to the log file's descriptor, without taking locks or
+ * waiting on the writer thread.
+ */
+void flushlog();
+
 /**
  * @brief The dynamic entity representing the player.
  */
@@ -299,7 +379,9 @@ extern bool initsdl();
  * @brief Immediately shuts down the game and prints error message(s)
  *
  * Shuts down SDL and closes the game immediately. Up to two error messages are
- * printed in a SDL message box after exiting the game.
+ * printed in a SDL message box after exiting the game. Log lines still queued
+ * for the log writer thread are written out from the calling thread before
+ * exiting, without waiting on the writer thread (see `flushlog()`).
  *
  * @param s a series of C strings corresponding to error messages
  */
@@ -739,6 +821,96 @@ extern void ignoremousemotion();
 extern void keyrepeat(bool on, int mask = ~0);
 
 
+// jobs
+
+/**
+ * @brief Engine-wide job system.
+ *
+ * Jobs are run by a pool of worker threads which steal work from each other's
+ * queues. Jobs may depend on other jobs, forming a task graph; a job is not
+ * started until all of its dependencies have finished. Work which must run on
+ * the main thread (GL calls, CubeScript execution) is queued separately and
+ * only run at phase barriers.
+ *
+ * The time each job takes is attributed to the frame phase it was added under
+ * (see `beginframephase()`).
+ */
+namespace jobs
+{
+    typedef int jobid; /**< handle to a queued job, negative if invalid */
+
+    /**
+     * @brief Starts the worker threads.
+     *
+     * The number of worker threads is set by the `jobthreads` variable; if it
+     * is 0, one fewer thread than the number of CPU cores is used.
+     */
+    void init();
+
+    /**
+     * @brief Waits for all queued jobs and stops the worker threads.
+     */
+    void cleanup();
+
+    /**
+     * @brief Queues a job to be run on a worker thread.
+     *
+     * @param phase the frame phase the job belongs to (see FramePhase enum in consts.h)
+     * @param job the function to run
+     * @param deps jobs which must finish before this job is started
+     *
+     * @return a handle to the queued job
+     */
+    jobid add(int phase, std::function<void()> job, const std::vector<jobid> &deps = {});
+
+    /**
+     * @brief Queues a job to be run on the main thread.
+     *
+     * The job is run at the next call to `barrier()` for its phase.
+     *
+     * @param phase the frame phase the job belongs to (see FramePhase enum in consts.h)
+     * @param job the function to run
+     */
+    void addmain(int phase, std::function<void()> job);
+
+    /**
+     * @brief Waits for the specified job to finish.
+     *
+     * The calling thread runs other queued jobs while it waits.
+     *
+     * @param job the job to wait on
+     */
+    void wait(jobid job);
+
+    /**
+     * @brief Waits for all jobs of a frame phase to finish.
+     *
+     * Must be called from the main thread; runs the main thread jobs queued for
+     * the phase, including any added by worker jobs while waiting.
+     *
+     * @param phase the frame phase to wait on (see FramePhase enum in consts.h)
+     */
+    void barrier(int phase);
+
+    /**
+     * @brief Returns whether the calling thread is the main thread.
+     */
+    bool ismainthread();
+
+    /**
+     * @brief Initializes job system CubeScript commands.
+     *
+     * `jobinfo` *int* type
+     *  - Returns the selected type of job system information (int)
+     *  - 0: worker threads running
+     *  - 1: jobs run during the last frame
+     *  - 2: jobs stolen from another worker's queue during the last frame
+     *  - 3: main thread jobs run during the last frame
+     *  - If a value not specified is entered, returns -1.
+     */
+    void initjobcmds();
+}
+
 // menus
 
 extern int mainmenu; /**< toggles if the main menu is shown, bool-like int */
@@ -769,9 +941,12 @@ extern void initmenuscmds();
  *
  * `textmode`
  *
- * `textsave`
+ * `textsave` *string* file
+ *  - Writes the contents of the current editor to the file, streaming the
+ *    editor's text pieces directly to the file.
  *
- * `textload`
+ * `textload` *string* file
+ *  - Loads the file into the current editor.
  *
  * `textcopy`
  *
@@ -785,7 +960,13 @@ extern void initmenuscmds();
  *
  * `textcurrentline`
  *
- * `textexec`
+ * `textexec` *int* selected
+ *  - Executes the contents of the current editor as CubeScript. If *selected*
+ *    is nonzero, only the selected text is executed.
+ *
+ * Editors store their text as a piece table, so inserts, deletes and pastes
+ * do not copy the rest of the buffer, and line starts are reindexed only for
+ * the lines that were edited.
  */
 
 extern void inittextcmds();
@@ -846,9 +1027,21 @@ namespace UI
 
     /**
      * @brief Updates cursor vis a vis the UI elements.
+     *
+     * Only UI elements whose inputs (text, size, visibility, or bound variable
+     * value) changed since the last update are laid out again; unchanged
+     * subtrees keep their previously computed geometry.
      */
     void update();
 
+    /**
+     * @brief Forces all UI windows to be laid out again on the next update.
+     *
+     * Used when a change affects every element regardless of its own inputs,
+     * such as a change in screen resolution or font.
+     */
+    void invalidatelayout();
+
     /**
      * @brief Deletes all of the open windows exposed and deletes the UI world object.
      */
@@ -1188,6 +1381,12 @@ namespace UI
      * `uiallowinput`
      *
      * `uieschide`
+     *
+     * `uilayoutinfo` *int* type
+     *  - Returns the selected type of UI layout information (int)
+     *  - 0: elements laid out during the last update
+     *  - 1: elements reusing their cached layout during the last update
+     *  - If a value not specified is entered, returns -1.
      */
     void inituicmds();
 }
@@ -1289,6 +1488,13 @@ extern void initnormalcmds();
  *
  * `recalc`
  *  - Recalculates the world geometry to merge cubes & faces where possible.
+ *
+ * `softocclusioninfo` *int* type
+ *  - Returns the selected type of software occlusion buffer information (int)
+ *  - 0: occluder cubes rasterized this frame
+ *  - 1: boxes tested against the occlusion buffer this frame
+ *  - 2: boxes found to be occluded this frame
+ *  - If a value not specified is entered, returns -1.
  */
 extern void initoctarendercmds();
 
@@ -1361,7 +1567,8 @@ extern vec minimapcenter, minimapradius, minimapscale;
  * @brief Binds a GL texture to the minimaptex global object.
  *
  * The global variable minimap texture, minimaptex, has a GL buffer bound to it.
- * Before this is called, no texture is associated with it.
+ * Before this is called, no texture is associated with it. If a minimap image
+ * generated by `genminimap()` has finished, it is uploaded first.
  */
 extern void bindminimap();
 
@@ -1471,6 +1678,24 @@ extern void gl_drawframe(int crosshairindex, void (*gamefxn)(), void (*hudfxn)()
  */
 extern void drawminimap(int yaw, int pitch, vec loc, const cubeworld& world, int scalefactor = 1);
 
+/**
+ * @brief Generates a minimap texture from the octree without rendering it.
+ *
+ * Rasterizes a top-down image of the world on a worker thread, using the height,
+ * material, and dominant top face texture of each column of cubes. The worker
+ * never reads `world` itself: before this function returns, the height, material
+ * and texture of each column are snapshotted on the main thread, and the worker
+ * rasterizes from that snapshot. Regions later passed to `cubeworld::changed()`
+ * are snapshotted again on the main thread before they are rasterized again
+ * incrementally. The image is uploaded to the minimaptex buffer by
+ * `bindminimap()` once it is complete; until then the previous minimap texture
+ * is kept.
+ *
+ * @param world the world to generate the minimap for
+ * @param scalefactor the texture zoom factor
+ */
+extern void genminimap(const cubeworld& world, int scalefactor = 1);
+
 // renderlights
 
 /**
@@ -1486,6 +1711,10 @@ extern void drawminimap(int yaw, int pitch, vec loc, const cubeworld& world, int
  *  - 3: lightbatchesused
  *  - 4: lightbatchrectsused
  *  - 5: lightbatchstacksused
+ *  - 6: lightclustersused
+ *  - 7: lightclusterindices
+ *  - 8: shadowcachehits
+ *  - 9: shadowcacheinvalidations
  *  - If a value not specified is entered, returns -1.
  *
  * `getcsmproperty` *int* type
@@ -1540,6 +1769,21 @@ extern void initrenderlightscmds();
  */
 extern void clearshadowcache();
 
+/**
+ * @brief Invalidates the cached shadow maps of lights touching a region.
+ *
+ * Only shadow maps of lights whose light volume intersects the box passed are
+ * marked for re-rendering; all other shadow map cache entries are kept. This is
+ * called for regions passed to `cubeworld::changed()` and for the bounds of
+ * moving mapmodels.
+ *
+ * @param bbmin the minimum corner of the region that changed
+ * @param bbmax the maximum corner of the region that changed
+ *
+ * @return the number of cached shadow maps invalidated
+ */
+extern int invalidateshadowcache(const ivec &bbmin, const ivec &bbmax);
+
 // rendermodel
 
 /**
@@ -1979,6 +2223,19 @@ extern void removetrackedparticles(physent *owner = nullptr);
  */
 extern void initparticles();
 
+/**
+ * @brief Initializes renderparticles CubeScript commands.
+ *
+ * `particleemitterinfo` *int* type
+ *  - Returns the selected type of particle emitter debug information (int)
+ *  - 0: emitters updated this frame
+ *  - 1: emitters culled by the view frustum
+ *  - 2: emitters culled by distance
+ *  - 3: emitters skipped due to the particle budget
+ *  - If a value not specified is entered, returns -1.
+ */
+extern void initrenderparticlescmds();
+
 // rendertext
 
 /**
@@ -1999,6 +2256,13 @@ extern void initparticles();
  * `fontchar`
  *
  * `fontskip`
+ *
+ * `textcacheinfo` *int* type
+ *  - Returns the selected type of text layout cache information (int)
+ *  - 0: layouts found in the cache this frame
+ *  - 1: layouts computed this frame
+ *  - 2: layouts currently cached
+ *  - If a value not specified is entered, returns -1.
  */
 extern void initrendertextcmds();
 
@@ -2014,6 +2278,16 @@ extern void initrendertextcmds();
  */
 extern bool setfont(const char *name);
 
+/**
+ * @brief Empties the text layout cache.
+ *
+ * Laid out text is cached by font, string, wrap width and scale, so that a
+ * string drawn every frame is only laid out once. The cache is emptied
+ * automatically when a font is defined or its glyphs change; this function
+ * drops all cached layouts immediately.
+ */
+extern void cleartextcache();
+
 // renderwindow
 
 extern SDL_Window *screen;
@@ -2029,6 +2303,22 @@ extern SDL_Window *screen;
  *
  * `screenres` *int* width *int* height
  *  - Sets the screen resolution to *width* by *height*
+ *
+ * `framephasetime` *int* phase *int* percentile
+ *  - Returns the time in microseconds spent in the frame phase (see FramePhase enum in consts.h)
+ *    at the given percentile (0..100) of the recorded frames. 100 returns the maximum time.
+ *
+ * `dumpframetrace` *string* file
+ *  - Writes the recorded frame phase timings to the file in Trace Event JSON format,
+ *    which can be opened by chrome://tracing or Perfetto.
+ *
+ * `framepacinginfo` *int* type
+ *  - Returns the selected type of frame pacing information (int)
+ *  - 0: average absolute error between frame deadline and frame start, in microseconds
+ *  - 1: maximum error between frame deadline and frame start, in microseconds
+ *  - 2: current estimate of sleep overshoot, in microseconds
+ *  - 3: idle tasks run during the last frame
+ *  - If a value not specified is entered, returns -1.
  */
 extern void initrenderwindowcmds();
 
@@ -2060,27 +2350,30 @@ extern void restorevsync();
 extern void resetfpshistory();
 
 /**
- * @brief delays a frame by a specified amount
+ * @brief Delays rendering of a frame.
  *
- * Uses SDL_Delay to delay a frame, given the time the last frame was
- * rendered and the current time. Takes into account the global fps cap global variable (maxfps) to calculate delay.
+ * Waits until the frame deadline given by the global maxfps and menufps
+ * variables. The wait sleeps for the bulk of the remaining time, less the
+ * sleep overshoot measured on previous frames, and then spins until the
+ * deadline. Idle tasks added with `addidletask()` are run before sleeping if
+ * there is enough time left before the deadline.
  *
- * @param millis: the time (in ms) since program started
- * @param curmillis: the last registered frame time
+ * @param millis the time (in ms) since program started
+ * @param curmillis the last registered frame time
  */
 extern void limitfps(int &millis, int curmillis);
 
 /**
- * @brief Delays rendering of a frame.
+ * @brief Queues a task to run in the idle time before a frame deadline.
  *
- * Uses SDL_Delay to delay a frame, given the time the last frame was
- * rendered and the current time. The amount of delay is calculated from the
- * global maxfps and menufps variables.
+ * Tasks are run on the main thread by `limitfps()`, one at a time, while the
+ * time remaining before the frame deadline is longer than the task's expected
+ * duration. Tasks not run in a frame are kept for later frames.
  *
- * @param millis the time (in ms) since program started
- * @param curmillis the last registered frame time
+ * @param task the task to run
+ * @param expectedmillis the expected duration of the task in ms
  */
-extern void limitfps(int &millis, int curmillis);
+extern void addidletask(std::function<void()> task, int expectedmillis = 1);
 
 /**
  * @brief Adds an entry to the fps history.
@@ -2092,6 +2385,51 @@ extern void limitfps(int &millis, int curmillis);
  */
 extern void updatefpshistory(int millis);
 
+/**
+ * @brief Marks the start of a timed frame phase.
+ *
+ * Phase timings are recorded once per frame into a fixed size history, which
+ * can be queried with `framephasetime` or written out with `dumpframetrace`.
+ * Phases may be timed from any thread, and the same phase may be timed by
+ * several threads at once (e.g. jobs of one phase running on several workers);
+ * each timing is identified by the token returned.
+ *
+ * @param phase the phase to time (see FramePhase enum in consts.h)
+ *
+ * @return a token identifying this timing, to be passed to endframephase()
+ */
+extern int beginframephase(int phase);
+
+/**
+ * @brief Marks the end of a timed frame phase.
+ *
+ * @param token the token returned by the matching beginframephase() call
+ */
+extern void endframephase(int token);
+
+/**
+ * @brief Times the frame phase for the lifetime of the object.
+ *
+ * Calls beginframephase() on construction and endframephase() on destruction.
+ */
+class framephasetimer final
+{
+    public:
+        explicit framephasetimer(int phase) : token(beginframephase(phase))
+        {
+        }
+
+        ~framephasetimer()
+        {
+            endframephase(token);
+        }
+
+        framephasetimer(const framephasetimer &) = delete;
+        framephasetimer &operator=(const framephasetimer &) = delete;
+    private:
+        int token;
+};
+
 /**
  * @brief Sets the SDL gamma level to 1.
  *
@@ -2214,6 +2552,23 @@ extern void loadshaders();
  * Fails to do anything if initing is set (early game loading time).
  */
 extern void initstains();
+
+/**
+ * @brief Queues a stain to be placed on the world geometry.
+ *
+ * The stain is not generated immediately; the geometry it covers is gathered
+ * and clipped by the stain worker thread, and the finished triangles are added
+ * to the stain buffers at the start of the next frame. A stain of the same type
+ * which overlaps a stain already queued this frame is merged into it, and stains
+ * queued beyond the per-frame stain budget are dropped.
+ *
+ * @param type the type of stain to place (see Stain enum in consts.h)
+ * @param center the location of the stain
+ * @param surface the normal of the surface the stain is placed on
+ * @param radius the radius of the stain
+ * @param color the color to tint the stain
+ * @param info the sub-texture index of the stain, if applicable
+ */
 extern void addstain(int type, const vec &center, const vec &surface, float radius, const bvec &color = bvec(0xFF, 0xFF, 0xFF), int info = 0);
 
 inline void addstain(int type, const vec &center, const vec &surface, float radius, int color, int info = 0)
@@ -2221,6 +2576,27 @@ inline void addstain(int type, const vec &center, const vec &surface, float radi
     addstain(type, center, surface, radius, bvec::hexcolor(color), info);
 }
 
+/**
+ * @brief Adds stains completed by the stain worker to the stain buffers.
+ *
+ * Called once per frame from the main thread; does not block waiting on stains
+ * which are still being generated.
+ */
+extern void flushstains();
+
+/**
+ * @brief Initializes stain CubeScript commands.
+ *
+ * `staininfo` *int* type
+ *  - Returns the selected type of stain debug information (int)
+ *  - 0: stains queued this frame
+ *  - 1: stains merged into an overlapping stain
+ *  - 2: stains dropped by the per-frame budget
+ *  - 3: stains pending on the stain worker
+ *  - If a value not specified is entered, returns -1.
+ */
+extern void initstaincmds();
+
 // texture
 
 /**
@@ -2366,6 +2742,25 @@ extern bool settexture(const char *name, int clamp = 0);
 
 // dynlight
 
+/**
+ * @brief Adds a dynamic light to the world for the current frame.
+ *
+ * Dynamic lights are binned together with the static light entities into the
+ * view-space light clusters before lighting is performed, so the cost of a
+ * dynamic light is limited to the clusters its volume overlaps.
+ *
+ * @param o the location of the light
+ * @param radius the radius of the light
+ * @param color the color of the light
+ * @param fade the time in ms for the light to fade out
+ * @param peak the time in ms before the light reaches its full radius
+ * @param flags the DynLight flags to apply (see consts.h)
+ * @param initradius the radius the light starts at before expanding
+ * @param initcolor the color the light starts at before peaking
+ * @param owner the entity to track the light's position with, if any
+ * @param dir the direction of the light, for spotlights
+ * @param spot the angle of the spotlight cone, or 0 for a point light
+ */
 extern void adddynlight(const vec &o, float radius, const vec &color, int fade = 0, int peak = 0, int flags = 0, float initradius = 0, const vec &initcolor = vec(0, 0, 0), physent *owner = nullptr, const vec &dir = vec(0, 0, 0), int spot = 0);
 extern void removetrackeddynlights(const physent *owner = nullptr);
 
@@ -2378,7 +2773,21 @@ extern void removetrackeddynlights(const physent *owner = nullptr);
  * @return false if no heightmap is active
  */
 extern bool isheightmap(int o, bool empty, const cube &c);
-extern void heightmaprun(int dir, int mode);
+
+/**
+ * @brief Applies the heightmap brush to the current selection.
+ *
+ * The heights of the cube columns under the brush are read into a dense height
+ * grid, the brush is applied to the whole grid at once, and only the columns
+ * whose height changed are written back to the octree.
+ *
+ * @param dir the direction to apply the brush (1 to raise, -1 to lower); for
+ *        HeightmapBrush_Smooth and HeightmapBrush_Flatten, columns move up or
+ *        down toward their target height and `dir` is ignored
+ * @param mode the editface mode, passed through from `editface`
+ * @param op the brush operation to apply (see HeightmapBrush enum in consts.h)
+ */
+extern void heightmaprun(int dir, int mode, int op = HeightmapBrush_Push);
 
 /**
  * @brief Initializes heightmap Cubescript commands.
@@ -2390,6 +2799,14 @@ extern void heightmaprun(int dir, int mode);
  * `clearhbrush`
  *
  * `hbrushvert`
+ *
+ * `hmapsmooth`
+ *  - Smooths the heightmap under the brush, averaging each column with its neighbors.
+ *  - Runs heightmaprun() with HeightmapBrush_Smooth.
+ *
+ * `hmapflatten`
+ *  - Flattens the heightmap under the brush to the height at the center of the brush.
+ *  - Runs heightmaprun() with HeightmapBrush_Flatten.
  */
 extern void initheightmapcmds();
 
@@ -2464,12 +2881,29 @@ extern void optiface(const uchar *p, cube &c);
  *
  * `clearundos`
  *
+ * `editcodec` *int* codec *int* level
+ *  - Sets the codec and compression level used to pack edits sent to other clients (see EditCodec enum in consts.h).
+ *  - Defaults to EditCodec_Zlib. Clients predating EditCodec_Block cannot decode it, so it should only be
+ *    selected when every client in the session supports it.
+ *  - Received edits are decoded with whichever codec they were packed with.
+ *
+ * `undoinfo` *int* type
+ *  - Returns the selected type of undo history information (int)
+ *  - 0: bytes used by uncompressed undo entries
+ *  - 1: bytes used by compressed undo entries
+ *  - 2: bytes of undo entries spilled to the temporary undo file
+ *  - 3: number of undo entries
+ *  - If a value not specified is entered, returns -1.
+ *
  * `delprefab`
  *
  * `saveprefab`
  *
  * `pasteprefab`
  *
+ * `clearprefabcache`
+ *  - Frees all cached prefab meshes held in memory.
+ *
  * `wtr`
  *  - Returns the number of world triangles
  *
@@ -2519,6 +2953,42 @@ extern int entediting;
 extern selinfo sel, lastsel;
 extern std::deque<undoblock *> undos, /**< list of cube undo operations */
                                redos; /**< list of cube operations available to redo */
+
+/**
+ * @brief Moves older undo entries into cheaper storage to fit the undo budget.
+ *
+ * The most recent entries are kept uncompressed; once the undo history exceeds
+ * `undomegs`, older entries are compressed on a background thread, and once the
+ * compressed entries exceed the budget as well, the oldest are written out to a
+ * temporary file. Compressed and spilled entries are restored on demand when
+ * they are undone or redone.
+ *
+ * The background thread only reads the entries it compresses and never touches
+ * `undos` or `redos`; finished compressed entries are swapped into the deque
+ * (replacing and freeing the uncompressed entry) on the main thread, as
+ * `addundo()` and `loadundo()` also modify the deque. An entry which is undone
+ * or freed while its compression is in flight has its compressed copy discarded.
+ */
+extern void compactundos();
+
+/**
+ * @brief Restores a compressed or spilled undo entry to its uncompressed form.
+ *
+ * Does nothing if the entry's `storage` is already UndoStorage_Raw. Otherwise,
+ * a new uncompressed entry is allocated and replaces the old one: the element
+ * in the deque is overwritten, the `prev`/`next` links of the neighboring
+ * entries are updated to point to it, and the old entry is freed by this
+ * function. Pointers to the old entry held elsewhere become invalid.
+ *
+ * Must be called before accessing the block or gridmap of an entry taken from
+ * `undos` or `redos`.
+ *
+ * @param u an iterator to the undo entry to restore, in `undos` or `redos`
+ *
+ * @return the uncompressed undo entry, also stored at `*u`
+ */
+extern undoblock *loadundo(std::deque<undoblock *>::iterator u);
+
 extern int nompedit;
 extern int hmapedit; /**< used as boolean, 0 if not heightmapping, 1 otherwise */
 extern bool havesel; /**< true if there is a set of cubes in selection, false otherwise */
@@ -2570,14 +3040,61 @@ extern bool editmoveplane(const vec &o, const vec &ray, int d, float off, vec &h
 /**
  * @brief Assigns selchildcount the number of cubes in selection.
  *
- * Recursively counts the number of cubes being selected in the current selection,
- * and assigns this value to selchildcount
+ * Counts the number of cubes being selected in the current selection, and
+ * assigns this value to selchildcount. Nodes entirely inside the selection are
+ * counted from their subtree statistics, so only nodes crossing the selection
+ * boundary are descended into.
+ *
+ * Also assigns selchildmat, combining the `subtreestats::commonmat` of each
+ * node (or the material of each boundary leaf) counted: it is the material
+ * shared by every cube in the selection that is not Mat_Air, Mat_Air if those
+ * cubes have differing materials, or -1 if every cube is Mat_Air.
  */
 extern void countselchild(const std::array<cube, 8> &c, const ivec &cor, int size);
+
+/**
+ * @brief Returns the aggregate statistics of a cube's subtree.
+ *
+ * For a leaf cube, the statistics describe the cube itself.
+ *
+ * @param c the cube to query
+ *
+ * @return the statistics of the cube and its children
+ */
+extern subtreestats getsubtreestats(const cube &c);
 extern void normalizelookupcube(const ivec &o);
 extern void updateselection();
 
+/**
+ * @brief Packs the copied block of an editinfo for sending over the network.
+ *
+ * The block is encoded with the codec given by `editcodec` (see EditCodec enum
+ * in consts.h). EditCodec_Block buffers begin with a codec byte which is not a
+ * valid zlib header, so that receivers can tell them apart from EditCodec_Zlib
+ * buffers sent by older clients. Older clients cannot decode EditCodec_Block
+ * buffers, which is why `editcodec` defaults to EditCodec_Zlib.
+ *
+ * @param e the editinfo to pack
+ * @param inlen assigned the length of the block before compression
+ * @param outbuf assigned a new buffer containing the packed block
+ * @param outlen assigned the length of outbuf
+ *
+ * @return true if the block was packed
+ */
 extern bool packeditinfo(const editinfo *e, int &inlen, uchar *&outbuf, int &outlen);
+
+/**
+ * @brief Unpacks a block packed by packeditinfo() into an editinfo.
+ *
+ * Accepts buffers packed with any of the edit codecs.
+ *
+ * @param e the editinfo to unpack into; created if nullptr
+ * @param inbuf the packed buffer
+ * @param inlen the length of inbuf
+ * @param outlen the length of the block before compression
+ *
+ * @return true if the block was unpacked
+ */
 extern bool unpackeditinfo(editinfo *&e, const uchar *inbuf, int inlen, int outlen);
 
 /**
@@ -2588,7 +3105,81 @@ extern bool unpackeditinfo(editinfo *&e, const uchar *inbuf, int inlen, int outl
  * @param e the editinfo object to destroy.
  */
 extern void freeeditinfo(editinfo *&e);
+
+/**
+ * @brief Packs the next undo or redo entry for sending over the network.
+ *
+ * The entry is encoded with the codec given by `editcodec`, as with
+ * packeditinfo(). Delta undo records are first expanded into a full block
+ * copy of their selection (the current cubes with the saved fields restored),
+ * so the packed format always holds a cube array and gridmap.
+ *
+ * @param undo true to pack the next undo entry, false for the next redo entry
+ * @param inlen assigned the length of the entry before compression
+ * @param outbuf assigned a new buffer containing the packed entry
+ * @param outlen assigned the length of outbuf
+ *
+ * @return true if an entry was packed
+ */
 extern bool packundo(bool undo, int &inlen, uchar *&outbuf, int &outlen);
+
+/**
+ * @brief Appends an edit operation to the edit log.
+ *
+ * The edit log is an ordered, append-only record of the edits applied to the
+ * world since the last checkpoint, which can be sent to clients joining an
+ * editing session so they do not have to download the entire map.
+ *
+ * Edits which cannot be expressed as one of the EditLog operations (such as
+ * resizing or replacing the map) force a checkpoint, so that the log never
+ * omits a change to the world. Entity edits and map variable changes are
+ * logged with EditLog_Entity and EditLog_Var and do not force a checkpoint.
+ *
+ * EditLog_Undo and EditLog_Redo carry the packed undo block produced by
+ * packundo() for the client that undid the edit; replaying them pastes that
+ * block and does not depend on the replaying client's `undos` or `redos`.
+ *
+ * @param op the type of edit (see EditLog enum in consts.h)
+ * @param sel the selection the edit was applied to
+ * @param args the operation's arguments, packed as by putint()
+ *
+ * @return the sequence number of the logged edit
+ */
+extern int logedit(int op, const selinfo &sel, const std::vector<uchar> &args);
+
+/**
+ * @brief Packs the edit log from a sequence number onwards.
+ *
+ * @param buf the buffer to pack the log entries into
+ * @param from the first sequence number to pack
+ *
+ * @return false if entries from `from` onwards were dropped by a checkpoint
+ */
+extern bool packeditlog(std::vector<uchar> &buf, int from);
+
+/**
+ * @brief Applies a packed edit log to the world.
+ *
+ * Edits are applied in order, with a single `cubeworld::changed()` for the
+ * combined bounds of every edit replayed. Replaying the same log against the
+ * same map always produces the same world.
+ *
+ * @param buf the buffer containing the packed log entries
+ * @param len the length of buf
+ *
+ * @return false if the buffer was malformed; edits before the error are kept
+ */
+extern bool replayeditlog(const uchar *buf, int len);
+
+/**
+ * @brief Saves a snapshot of the world and truncates the edit log.
+ *
+ * Clients joining after a checkpoint load the snapshot and then replay the
+ * edits logged since.
+ *
+ * @param mname the map file name to save the snapshot to
+ */
+extern void checkpointeditlog(const char *mname);
 extern bool noedit(bool view = false, bool msg = true);
 
 /**
@@ -2623,6 +3214,10 @@ extern void addundo(undoblock *u);
 /**
  * @brief Looks up a world cube inside the block passed.
  *
+ * Descends the octree from the world root for each call; callers visiting
+ * every cube in a block at a single grid size without depending on scanline
+ * order may use `blockcursor` instead.
+ *
  * @param x the x coordiante inside the block3 to look up
  * @param y the y coordiante inside the block3 to look up
  * @param z the z coordiante inside the block3 to look up
@@ -2642,6 +3237,26 @@ extern cube &blockcube(int x, int y, int z, const block3 &b, int rgrid);
  */
 extern void makeundo(selinfo &s);
 
+/**
+ * @brief Adds a delta undo entry for an edit changing only some cube fields.
+ *
+ * Rather than copying the whole selection, only the fields flagged in `fields`
+ * are saved, and only for the cubes that the edit changes; cubes left unchanged
+ * by the edit are dropped from the record once the edit is finished. Falls back
+ * to a full undo entry (as `makeundo(selinfo &)`) if any cube in the selection
+ * has children, whatever `fields` is set to, since edits such as edittexcube()
+ * recurse into children, which a delta record cannot restore. If the edit
+ * changes no cubes, the empty delta record is discarded rather than added to
+ * `undos`.
+ *
+ * Delta records are identified by a nonzero `undoblock::deltafields`; undoing
+ * or redoing one goes through pasteundodelta() rather than pasteundoblock().
+ *
+ * @param s the selection to use
+ * @param fields a mask of the UndoDelta fields that the edit may change
+ */
+extern void makeundo(selinfo &s, int fields);
+
 /**
  * @brief Adds an undo entry to the undos vector given the current selection.
  *
@@ -2691,9 +3306,34 @@ extern void freeundo(undoblock *u);
  */
 extern void pasteblock(const block3 &b, selinfo &sel, bool local);
 
+/**
+ * @brief Runs an edit over every cube in a selection, in parallel.
+ *
+ * Splits the selection into the octree subtrees it covers and runs the edit on
+ * each subtree as a separate job. If `local` is true, an undo entry is captured
+ * for each subtree by the job editing it, and these are merged into a single
+ * undo entry. The world is marked as changed once, after all jobs finish.
+ *
+ * The edit function is called once per cube at the selection's grid size. That
+ * cube may have children, which the edit may recurse into (as edittexcube()
+ * does), but it must not modify any cube outside of the cube passed and its
+ * subtree. It must also not call functions which touch global edit or render
+ * state, such as `cube::discardchildren()`, or which free vertex arrays or cube
+ * extensions, since these are shared between the jobs.
+ *
+ * @param sel the selection to edit
+ * @param local whether the edit was made locally (and should be undoable)
+ * @param f the edit to run, given the cube and its x, y, z position in the selection
+ */
+extern void loopselparallel(selinfo &sel, bool local, const std::function<void(cube &, int, int, int)> &f);
+
 /**
  * @brief Creates an undoblock object given a cube selection.
  *
+ * The undoblock header is allocated as raw memory, so `numdeltas`,
+ * `deltafields` and `storage` are explicitly zeroed to mark the entry as a full,
+ * uncompressed undo record.
+ *
  * @param s the selection information to give to the undoblock object
  *
  * @return a pointer to a new heap-allocated undoblock object
@@ -2701,6 +3341,38 @@ extern void pasteblock(const block3 &b, selinfo &sel, bool local);
 extern undoblock *newundocube(const selinfo &s);
 extern void remapvslots(cube &c, bool delta, const VSlot &ds, int orient, bool &findrep, VSlot *&findedit);
 
+/**
+ * @brief Finds the vslot remapping needed to apply a vslot edit to a selection.
+ *
+ * Collects the distinct vslots used by the faces of the selection which the
+ * edit applies to, and resolves the edited vslot for each once (through
+ * `editvslot()`/`findvslot()`), rather than once per face.
+ *
+ * @param sel the selection to be edited
+ * @param delta whether ds is a delta to apply to the existing vslots
+ * @param ds the vslot properties to apply
+ * @param orient the face to edit; -1 indicates all faces
+ * @param remap assigned the old vslot index to new vslot index mapping
+ */
+extern void findvslotremap(const selinfo &sel, bool delta, const VSlot &ds, int orient, std::unordered_map<ushort, ushort> &remap);
+
+/**
+ * @brief Applies a vslot remapping to the faces of a selection.
+ *
+ * Replaces the texture index of each face in the selection found in `remap`
+ * with its mapped index. Cubes in the selection which are subdivided below the
+ * selection's grid size are remapped through all of their children, so no face
+ * in the selection is left on an old vslot. Runs over the selection in parallel
+ * with `loopselparallel()`, each job recursing into the subtree of the cube it
+ * is passed.
+ *
+ * @param sel the selection to edit
+ * @param orient the face to edit; -1 indicates all faces
+ * @param remap the old vslot index to new vslot index mapping to apply
+ * @param local whether the edit was made locally (and should be undoable)
+ */
+extern void applyvslotremap(selinfo &sel, int orient, const std::unordered_map<ushort, ushort> &remap, bool local);
+
 /**
  * @brief Changes the texture for a cube and its children.
  *
@@ -2758,10 +3430,35 @@ extern void pastecube(const cube &src, cube &dst);
 /**
  * @brief Pastes an undo block associated with the passed block3 object.
  *
+ * Only for full undo records; the block3 of a delta undo record (nonzero
+ * `undoblock::deltafields`) has no cube array or gridmap, and must be pasted
+ * with pasteundodelta() instead.
+ *
  * @param b the block3 to use to paste
  * @param g the gridscale array to pass
  */
 extern void pasteundoblock(block3 *b, const uchar *g);
+
+/**
+ * @brief Restores the cubes saved in a delta undo entry.
+ *
+ * @param u the delta undo entry to paste
+ */
+extern void pasteundodelta(undoblock *u);
+
+/**
+ * @brief Decompresses a buffer packed by packeditinfo() or packundo().
+ *
+ * Detects the codec from the start of the buffer, accepting both EditCodec_Zlib
+ * buffers from older clients and EditCodec_Block buffers.
+ *
+ * @param inbuf the packed buffer
+ * @param inlen the length of inbuf
+ * @param outbuf assigned a new buffer containing the decompressed data
+ * @param outlen the expected length of the decompressed data; assigned its actual length
+ *
+ * @return true if the buffer was decompressed
+ */
 extern bool uncompresseditinfo(const uchar *inbuf, int inlen, uchar *&outbuf, int &outlen);
 
 /**
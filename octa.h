@@ -389,18 +389,68 @@ struct undoent
     entity e;
 };
 
-struct undoblock /**< undo header, all data sits in payload */
+enum
+{
+    UndoDelta_Texture  = 1<<0,
+    UndoDelta_Material = 1<<1,
+    UndoDelta_Geometry = 1<<2
+};
+
+/**
+ * @brief The prior state of a single changed cube in a delta undo record.
+ *
+ * Only the fields flagged in the owning undoblock's `deltafields` are valid.
+ * Delta records only describe leaf cubes; edits which add or remove children
+ * are recorded as full block copies instead.
+ */
+struct undocubedelta
+{
+    ushort x, y, z;      /**< position of the cube within the undo record's block3, at its grid */
+    ushort texture[6];
+    ushort material;
+    uint faces[3];
+};
+
+enum
+{
+    UndoStorage_Raw = 0,    // payload is the uncompressed undo record
+    UndoStorage_Compressed, // payload is the compressed undo record
+    UndoStorage_Spilled     // payload is the offset of the record in the temporary undo file
+};
+
+/**
+ * @brief Undo header, all data sits in payload.
+ *
+ * Undo headers are raw allocations: newundocube() and newundoent() must zero
+ * `numdeltas`, `deltafields` and `storage`.
+ */
+struct undoblock
 {
     undoblock *prev, *next;
     int size,       /**< size of undo block */
         timestamp,  /**< time of creation */
-        numents;    /**< if numents is 0, is a cube undo record, otherwise an entity undo record */
+        numents,    /**< if numents is 0, is a cube undo record, otherwise an entity undo record */
+        numdeltas,  /**< number of changed cubes stored by a delta undo record (always nonzero for delta records) */
+        deltafields, /**< mask of UndoDelta fields stored; nonzero marks a delta undo record, 0 a full block copy */
+        storage;     /**< how the payload is stored, one of the UndoStorage values */
 
     block3 *block()
     {
         return reinterpret_cast<block3 *>(this + 1);
     }
 
+    /**
+     * @brief Returns the changed cubes of a delta undo record.
+     *
+     * The deltas follow the block3 header directly, which has no cube array
+     * for delta undo records; only valid if `deltafields` is nonzero, in which
+     * case `block()->c()` and `gridmap()` must not be used.
+     */
+    undocubedelta *deltas()
+    {
+        return reinterpret_cast<undocubedelta *>(block() + 1);
+    }
+
     uchar *gridmap()
     {
         block3 *ub = block();
@@ -413,6 +463,20 @@ struct undoblock /**< undo header, all data sits in payload */
     }
 };
 
+/**
+ * @brief Aggregate statistics of the cubes in an octree subtree.
+ *
+ * Maintained incrementally as cubes are edited, so that the contents of a
+ * subtree can be summarized without visiting its leaves.
+ */
+struct subtreestats
+{
+    int leaves, /**< number of leaf cubes in the subtree */
+        solid,  /**< number of entirely solid leaf cubes */
+        empty;  /**< number of empty leaf cubes */
+    int commonmat; /**< material shared by every leaf cube not of Mat_Air; -1 if every leaf is Mat_Air, Mat_Air if they differ */
+};
+
 extern int selchildcount, selchildmat;
 
 /**
@@ -428,10 +492,83 @@ inline int octadim(int d)
     return 1<<d;
 }
 
+/**
+ * @brief Iterates over the world cubes inside a block3 volume.
+ *
+ * Visits every cube of the block at the block's grid size, as `blockcube()`
+ * would return them, but walks the octree depth first in Morton order instead
+ * of descending from the world root for every cube. Cubes larger than `rgrid`
+ * are subdivided as they are reached, as with `blockcube()`.
+ *
+ * This is an opt-in alternative to LOOP_XYZ, not a drop-in replacement:
+ *  - the grid size `rgrid` is fixed for the whole iteration, so callers which
+ *    pick a grid per cell (such as pasting an undo block with its gridmap)
+ *    cannot use it
+ *  - cubes are visited in Morton order rather than the scanline order of
+ *    LOOP_XYZ, so callers which walk a parallel array with the loop (such as
+ *    the cube array of `block3::c()` or an undo gridmap) must index it by the
+ *    x, y, z position of the current cube instead of advancing a pointer
+ *
+ * The x, y, z coordinates of the current cube are those `blockcube()` takes.
+ */
+class blockcursor final
+{
+    public:
+        int x, y, z; /**< position of the current cube in the block, as passed to blockcube() */
+
+        /**
+         * @brief Creates a cursor positioned before the first cube of the block.
+         *
+         * @param b the block to iterate over
+         * @param rgrid the grid size to subdivide cubes down to
+         */
+        blockcursor(const block3 &b, int rgrid);
+
+        /**
+         * @brief Moves to the next cube in the block.
+         *
+         * @return true if the cursor moved to a cube
+         * @return false if every cube in the block has been visited
+         */
+        bool next();
+
+        /**
+         * @brief Returns the current cube.
+         *
+         * Only valid after next() has returned true.
+         */
+        cube &c() const
+        {
+            return *cur;
+        }
+
+    private:
+        struct level
+        {
+            std::array<cube, 8> *children;
+            ivec o;
+            int size,
+                child; /**< index of the next child to visit */
+        };
+
+        static constexpr int maxdepth = 16;
+
+        block3 b;
+        int rgrid;
+        ivec bbmin, bbmax; /**< world space bounds of the block */
+        std::array<level, maxdepth> stack;
+        int depth;
+        cube *cur;
+
+        void setpos(const ivec &o);
+};
+
 //note that these macros actually loop in the opposite order: e.g. loopxy runs a for loop of x inside y
 #define LOOP_XY(b)        for(int y = 0; y < (b).s[C[DIMENSION((b).orient)]]; ++y) for(int x = 0; x < (b).s[R[DIMENSION((b).orient)]]; ++x)
 #define LOOP_XYZ(b, r, f) { for(int z = 0; z < (b).s[D[DIMENSION((b).orient)]]; ++z) LOOP_XY((b)) { cube &c = blockcube(x,y,z,b,r); f; } }
 #define LOOP_SEL_XYZ(f)    { if(local) makeundo(); LOOP_XYZ(sel, sel.grid, f); rootworld.changed(sel); }
+//runs f concurrently over subtrees of the selection; f may only modify the cube `c` passed to it and its children, see loopselparallel()
+#define LOOP_SEL_XYZ_PARALLEL(f) { loopselparallel(sel, local, [&](cube &c, int x, int y, int z) { f; }); }
 #define SELECT_CUBE(x, y, z) blockcube(x, y, z, sel, sel.grid)
 
 // guard against subdivision
@@ -535,7 +672,27 @@ class cubeworld
          * world.
          */
         int compactvslots(bool cull = false);
-        void genprefabmesh(prefab &p);
+
+        /**
+         * @brief Gets the render geometry for a prefab.
+         *
+         * Prefab meshes are cached by a hash of the prefab's contents, both in
+         * memory (evicting the least recently used mesh) and, if `prefabcachedir`
+         * is set, on disk. On a cache miss, the mesh is built on a worker thread
+         * and the prefab's bounding box should be drawn until it is ready.
+         *
+         * The worker builds from a copy of the prefab's block taken before this
+         * function returns, never from `p` itself, so deleting the prefab
+         * (`delprefab`) while its build is in flight is safe. Builds which finish
+         * after their prefab was deleted, or after `clearprefabcache`, are
+         * discarded rather than added to the cache.
+         *
+         * @param p the prefab to get the mesh for
+         *
+         * @return true if the prefab's mesh is ready to render
+         * @return false if the mesh is still being built
+         */
+        bool genprefabmesh(prefab &p);
 
         /**
          * @brief Destroys vertex arrays for the octree world.
@@ -566,6 +723,22 @@ class cubeworld
          * @param rsize the found size (gridpower) of the cube to be assigned by reference
          */
         cube &lookupcube(const ivec &to, int tsize = 0, ivec &ro = lu, int &rsize = lusize);
+
+        /**
+         * @brief Returns whether a bounding box is hidden behind world geometry.
+         *
+         * If the software occlusion buffer is enabled, the box is tested against
+         * the low resolution depth buffer rasterized this frame from the large
+         * solid cubes nearest the camera; this test has no frame of latency and
+         * is also used for culling models flagged with Model_CullOccluded.
+         * Otherwise, the box is tested against the results of the previous
+         * frame's occlusion queries.
+         *
+         * @param bo the minimum corner of the box
+         * @param br the maximum corner of the box
+         *
+         * @return true if the box is entirely occluded
+         */
         bool bboccluded(const ivec &bo, const ivec &br) const;
         void findtjoints();
         void allchanged(bool load = false);
@@ -613,6 +786,16 @@ class cubeworld
 
         void entitiesinoctanodes();
         void commitchanges(bool force = false);
+
+        /**
+         * @brief Emits particles from the world's particle entities.
+         *
+         * Only emitters whose octree node passes the view frustum check and
+         * which lie within the maximum emitter distance are updated; the emission
+         * rate of each remaining emitter is scaled down with its distance from
+         * the camera. Once the global particle budget is reached, emitters
+         * further from the camera are skipped for the rest of the frame.
+         */
         void updateparticles();
 
         /**
@@ -692,7 +875,28 @@ class cubeworld
          */
         void octarender();
         void seedparticles();
-        void makeparticles(const entity &e);
+
+        /**
+         * @brief Spawns the particles for a single particle entity.
+         *
+         * @param e the particle entity to emit from
+         * @param lod the emission rate scale (0..1) to apply to the emitter
+         */
+        void makeparticles(const entity &e, float lod = 1.f);
+
+        /**
+         * @brief Determines whether a particle emitter should be updated this frame.
+         *
+         * Rejects emitters outside of the view frustum (tested against the octree
+         * node bounds the entity is in) or beyond the maximum emitter distance.
+         *
+         * @param e the particle entity to check
+         * @param lod set to the emission rate scale for the emitter's distance
+         *
+         * @return true if the emitter is visible and should emit particles
+         * @return false if the emitter was culled
+         */
+        bool emittervisible(const extentity &e, float &lod) const;
 
         /**
          * @brief Resets the metadata associated with a map.
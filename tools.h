@@ -511,6 +511,96 @@ struct stream
     SDL_RWops *rwops();
 };
 
+/**
+ * @brief Reads lines from a stream through a single buffer.
+ *
+ * Reads the underlying stream in large blocks and scans the buffered data for
+ * line breaks with memchr(), rather than reading the stream one character at a
+ * time as `stream::getline()` does. Lines are returned as views into the
+ * buffer, so no copy of the line is made.
+ */
+class streamlinereader final
+{
+    public:
+        /**
+         * @brief Creates a line reader for the given stream.
+         *
+         * The reader does not take ownership of the stream, which must outlive
+         * the reader.
+         *
+         * @param f the stream to read from
+         * @param bufsize the initial size of the read buffer, in bytes
+         */
+        streamlinereader(stream *f, size_t bufsize = 16384) : f(f), buf(max(bufsize, static_cast<size_t>(1))), start(0), end(0), eof(false) {}
+
+        /**
+         * @brief Gets the next line from the stream.
+         *
+         * The line assigned does not include its terminating newline. The final
+         * line of the stream is returned even if it has no terminating newline.
+         * The buffer grows as needed to hold lines longer than the buffer size.
+         *
+         * @param line assigned a view of the line read; only valid until the next call
+         *
+         * @return true if a line was read
+         * @return false if the end of the stream was reached
+         */
+        bool getline(std::string_view &line)
+        {
+            for(;;)
+            {
+                const char *linestart = buf.data() + start;
+                const char *newline = static_cast<const char *>(std::memchr(linestart, '\n', end - start));
+                if(newline)
+                {
+                    size_t len = newline - linestart;
+                    line = std::string_view(linestart, len);
+                    start += len + 1;
+                    return true;
+                }
+                if(eof)
+                {
+                    if(start == end)
+                    {
+                        return false;
+                    }
+                    line = std::string_view(linestart, end - start);
+                    start = end;
+                    return true;
+                }
+                fill();
+            }
+        }
+
+    private:
+        stream *f;
+        std::vector<char> buf;
+        size_t start, /**< index of the first unread byte in buf */
+               end;   /**< index one past the last valid byte in buf */
+        bool eof;
+
+        //moves unread data to the front of the buffer, then reads more data after it
+        void fill()
+        {
+            if(start > 0)
+            {
+                std::memmove(buf.data(), buf.data() + start, end - start);
+                end -= start;
+                start = 0;
+            }
+            if(end == buf.size())
+            {
+                buf.resize(buf.size()*2);
+            }
+            size_t len = f->read(buf.data() + end, buf.size() - end);
+            if(!len)
+            {
+                eof = true;
+            }
+            end += len;
+        }
+};
+
 extern string homedir;
 
 extern char *path(char *s);